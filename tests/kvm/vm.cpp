@@ -1,7 +1,28 @@
 #define CATCH_CONFIG_MAIN
 
 #include <catch2/catch.hpp>
+#include <chrono> // seconds, steady_clock
+#include <fstream> // ifstream
+#include <unistd.h> // sysconf, _SC_PAGESIZE
+
 #include "vmm/kvm/kvm.hpp"
+#include "vmm/memory/memory.hpp"
+
+namespace {
+
+// Returns the resident set size of the calling process.
+auto resident_bytes() -> uint64_t
+{
+    auto statm = std::ifstream{"/proc/self/statm"};
+    auto size = uint64_t{};
+    auto resident = uint64_t{};
+
+    statm >> size >> resident;
+
+    return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+}  // namespace
 
 TEST_CASE("VM creation") {
     REQUIRE_NOTHROW(vmm::kvm::System{}.vm());
@@ -50,6 +71,62 @@ TEST_CASE("vCPU and memory slot information") {
     REQUIRE(vm.num_memslots() >= 32);
 }
 
+TEST_CASE("Huge sparse memory") {
+    using MmapRegion = vmm::memory::MmapRegion;
+    using Vm = vmm::kvm::Vm;
+
+    const auto mem_size = uint64_t{16} << 40;
+    const auto guest_addr = uint64_t{1} << 32;
+    const auto page_size = MmapRegion::page_size();
+    const auto max_size = Vm::max_memslot_size();
+
+    auto kvm = vmm::kvm::System{};
+    auto vm = kvm.vm();
+
+    const auto rss = resident_bytes();
+    const auto start = std::chrono::steady_clock::now();
+
+    auto region = MmapRegion{mem_size};
+    const auto slots = vm.set_memslots(0, guest_addr, mem_size, region.addr(), 0);
+
+    // Setup time and memory overhead don't depend on the configured size...
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds{5});
+    REQUIRE(resident_bytes() - rss < (uint64_t{64} << 20));
+    REQUIRE(slots == (mem_size + max_size - 1) / max_size);
+    REQUIRE(slots > 1);
+
+    // ...only on the pages which are touched (up to a huge page each).
+    const auto touched = uint64_t{64};
+
+    for (auto i = uint64_t{}; i < touched; i++)
+        region.data()[i * (mem_size / touched)] = 1;
+
+    const auto growth = resident_bytes() - rss;
+    REQUIRE(growth >= touched * page_size);
+    REQUIRE(growth < (uint64_t{64} << 20) + touched * (uint64_t{2} << 20));
+}
+
+TEST_CASE("Dirty log bitmap reuse") {
+    using MmapRegion = vmm::memory::MmapRegion;
+
+    const auto mem_size = uint64_t{1} << 20;
+
+    auto kvm = vmm::kvm::System{};
+    auto vm = kvm.vm();
+    auto region = MmapRegion{mem_size};
+
+    vm.set_memslot(0, 0, mem_size, region.addr(), KVM_MEM_LOG_DIRTY_PAGES);
+
+    auto bitmap = std::vector<uint64_t>{};
+    vm.dirty_log(0, mem_size, bitmap);
+
+    const auto data = bitmap.data();
+    REQUIRE(bitmap.size() == mem_size / MmapRegion::page_size() / 64);
+
+    vm.dirty_log(0, mem_size, bitmap);
+    REQUIRE(bitmap.data() == data);
+}
+
 TEST_CASE("IOEvent") {
     using EventFd = vmm::types::EventFd;
     using IoEventAddress = vmm::types::IoEventAddress;
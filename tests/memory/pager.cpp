@@ -0,0 +1,221 @@
+#define CATCH_CONFIG_MAIN
+
+#include <catch2/catch.hpp>
+#include <atomic> // atomic
+#include <cstring> // memset
+#include <filesystem> // temp_directory_path
+#include <functional> // function
+#include <memory> // make_unique
+#include <thread> // thread
+#include <vector> // vector
+#include <sys/mman.h> // mincore
+
+#include "vmm/memory/memory.hpp"
+
+namespace vm = vmm::memory;
+
+namespace {
+
+// Serves faults for a pager on a separate thread. Everything else done to
+// the pager is also run on that thread through `run()`.
+class PagerThread
+{
+    private:
+        vm::Pager& m_pager;
+        std::atomic<bool> m_stop = false;
+        std::atomic<std::function<void()>*> m_task = nullptr;
+        std::thread m_thread;
+    public:
+        explicit PagerThread(vm::Pager& pager)
+            : m_pager{pager}, m_thread{[this] {
+                while (!m_stop) {
+                    m_pager.handle_faults(1);
+
+                    if (auto task = m_task.load()) {
+                        (*task)();
+                        m_task = nullptr;
+                    }
+                }
+            }} {}
+
+        ~PagerThread()
+        {
+            m_stop = true;
+            m_thread.join();
+        }
+
+        auto run(std::function<void()> fn) -> void
+        {
+            m_task = &fn;
+            while (m_task.load())
+                std::this_thread::yield();
+        }
+};
+
+auto fill(const vm::MmapRegion& region) -> void
+{
+    const auto page_size = vm::MmapRegion::page_size();
+
+    for (auto i = std::size_t{}; i < region.size() / page_size; i++)
+        std::memset(region.data() + i * page_size, static_cast<int>(i % 255 + 1), page_size);
+}
+
+auto verify(const vm::MmapRegion& region) -> bool
+{
+    const auto page_size = vm::MmapRegion::page_size();
+
+    for (auto i = std::size_t{}; i < region.size(); i++) {
+        if (region.data()[i] != static_cast<uint8_t>(i / page_size % 255 + 1))
+            return false;
+    }
+
+    return true;
+}
+
+auto resident(const vm::MmapRegion& region, std::size_t index) -> bool
+{
+    const auto page_size = vm::MmapRegion::page_size();
+    auto vec = static_cast<unsigned char>(0);
+
+    REQUIRE(::mincore(region.data() + index * page_size, page_size, &vec) == 0);
+
+    return vec & 1;
+}
+
+}  // namespace
+
+TEST_CASE("Pool page store") {
+    const auto page_size = vm::MmapRegion::page_size();
+    auto store = vm::PoolPageStore{3};
+    auto page = std::vector<uint8_t>(page_size);
+    auto out = std::vector<uint8_t>(page_size, 0xff);
+
+    SECTION("Zero pages") {
+        store.store(0, page.data());
+        REQUIRE(store.bytes() == 0);
+
+        store.load(0, out.data());
+        REQUIRE(out == page);
+    }
+
+    SECTION("Compressible pages") {
+        std::memset(page.data(), 0xab, page_size / 2);
+
+        store.store(1, page.data());
+        REQUIRE(store.bytes() > 0);
+        REQUIRE(store.bytes() < page_size);
+
+        store.load(1, out.data());
+        REQUIRE(out == page);
+
+        store.discard(1);
+        REQUIRE(store.bytes() == 0);
+    }
+
+    SECTION("Incompressible pages") {
+        auto state = uint32_t{0x1234'5678};
+        for (auto& b : page) {
+            state = state * 1'664'525 + 1'013'904'223;
+            b = static_cast<uint8_t>(state >> 24);
+        }
+
+        store.store(2, page.data());
+        REQUIRE(store.bytes() == page_size);
+
+        store.load(2, out.data());
+        REQUIRE(out == page);
+    }
+}
+
+TEST_CASE("File page store") {
+    const auto page_size = vm::MmapRegion::page_size();
+    auto store = vm::FilePageStore{std::filesystem::temp_directory_path()};
+    auto page = std::vector<uint8_t>(page_size, 0x5a);
+    auto out = std::vector<uint8_t>(page_size);
+
+    store.store(7, page.data());
+    store.load(7, out.data());
+    REQUIRE(out == page);
+
+    // Never-stored pages read back as zeroes.
+    store.load(100, out.data());
+    REQUIRE(out == std::vector<uint8_t>(page_size));
+}
+
+TEST_CASE("Eviction and fault-in") {
+    const auto num_pages = std::size_t{64};
+    const auto readahead = std::size_t{4};
+
+    auto region = vm::MmapRegion{num_pages * vm::MmapRegion::page_size()};
+    auto pager = vm::Pager{region,
+                           std::make_unique<vm::PoolPageStore>(num_pages),
+                           num_pages, readahead};
+
+    {
+        auto thread = PagerThread{pager};
+
+        auto evicted = std::size_t{};
+
+        fill(region);
+        thread.run([&] { evicted = pager.evict(num_pages); });
+
+        REQUIRE(evicted == num_pages);
+        REQUIRE(pager.resident() == 0);
+        REQUIRE(!resident(region, 0));
+        REQUIRE(verify(region));
+    }
+
+    REQUIRE(pager.resident() == num_pages);
+    REQUIRE(pager.evictions() == num_pages);
+    REQUIRE(pager.readahead_pages() > 0);
+    REQUIRE(pager.faults() + pager.readahead_pages() == 2 * num_pages);
+}
+
+TEST_CASE("Resident limit") {
+    const auto num_pages = std::size_t{64};
+    const auto limit = std::size_t{16};
+
+    auto region = vm::MmapRegion{num_pages * vm::MmapRegion::page_size()};
+    auto pager = vm::Pager{region,
+                           std::make_unique<vm::FilePageStore>(std::filesystem::temp_directory_path()),
+                           limit};
+
+    {
+        auto thread = PagerThread{pager};
+
+        fill(region);
+        REQUIRE(verify(region));
+    }
+
+    REQUIRE(pager.resident() <= limit);
+    REQUIRE(pager.evictions() >= num_pages - limit);
+}
+
+TEST_CASE("Victim selection") {
+    const auto num_pages = std::size_t{4};
+
+    auto region = vm::MmapRegion{num_pages * vm::MmapRegion::page_size()};
+    auto pager = vm::Pager{region,
+                           std::make_unique<vm::PoolPageStore>(num_pages),
+                           num_pages, 0};
+    auto thread = PagerThread{pager};
+
+    auto evicted = std::size_t{};
+
+    fill(region);
+
+    // Pages 0 and 1 are accessed every round, pages 2 and 3 never are.
+    thread.run([&] {
+        for (auto round = 0; round < 4; round++)
+            pager.mark_accessed({0b0011});
+
+        evicted = pager.evict(2);
+    });
+
+    REQUIRE(evicted == 2);
+    REQUIRE(resident(region, 0));
+    REQUIRE(resident(region, 1));
+    REQUIRE(!resident(region, 2));
+    REQUIRE(!resident(region, 3));
+    REQUIRE(verify(region));
+}
@@ -0,0 +1,144 @@
+#define CATCH_CONFIG_MAIN
+
+#include <catch2/catch.hpp>
+#include <algorithm> // max
+#include <chrono> // milliseconds
+#include <functional> // ref
+#include <map> // map
+#include <thread> // sleep_for
+#include <utility> // exchange
+#include <vector> // vector
+
+#include "vmm/memory/memory.hpp"
+
+namespace vm = vmm::memory;
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// Stands in for `kvm::Vm::dirty_log()`, returning and clearing whatever
+// bitmap was queued for a slot.
+class FakeDirtyLog
+{
+    private:
+        std::map<uint32_t, std::vector<uint64_t>> m_bitmaps;
+    public:
+        std::size_t calls = 0;
+
+        auto dirty(uint32_t slot, std::size_t page) -> void
+        {
+            auto& bitmap = m_bitmaps[slot];
+            bitmap.resize(std::max(bitmap.size(), page / 64 + 1));
+            bitmap[page / 64] |= uint64_t{1} << (page % 64);
+        }
+
+        auto operator()(uint32_t slot, uint64_t) -> std::vector<uint64_t>
+        {
+            calls++;
+            return std::exchange(m_bitmaps[slot], {});
+        }
+};
+
+}  // namespace
+
+TEST_CASE("Age histogram") {
+    const auto page_size = vm::MmapRegion::page_size();
+    const auto num_pages = std::size_t{128};
+
+    auto log = FakeDirtyLog{};
+    auto estimator = vm::WorkingSetEstimator{std::ref(log), 1h, num_pages, {1, 4}};
+    const auto region = estimator.add_region(0, num_pages * page_size);
+
+    // Nothing has been seen yet.
+    REQUIRE(estimator.histogram(region) == std::vector<std::size_t>{0, 0, num_pages});
+    REQUIRE(estimator.working_set(UINT8_MAX) == 0);
+
+    // Pages 0-15 are touched once, pages 0-7 every time.
+    for (auto page = std::size_t{}; page < 16; page++)
+        log.dirty(0, page);
+
+    REQUIRE(estimator.sample() == num_pages);
+
+    for (auto round = 0; round < 2; round++) {
+        for (auto page = std::size_t{}; page < 8; page++)
+            log.dirty(0, page);
+
+        estimator.sample();
+    }
+
+    REQUIRE(estimator.histogram(region) == std::vector<std::size_t>{8, 8, num_pages - 16});
+    REQUIRE(estimator.working_set(region, 1) == 8 * page_size);
+    REQUIRE(estimator.working_set(4) == 16 * page_size);
+    REQUIRE(estimator.samples() == 3);
+}
+
+TEST_CASE("Sampling budget") {
+    const auto page_size = vm::MmapRegion::page_size();
+    const auto num_pages = std::size_t{64};
+
+    auto log = FakeDirtyLog{};
+    auto estimator = vm::WorkingSetEstimator{std::ref(log), 1h, num_pages};
+
+    for (auto slot = uint32_t{}; slot < 4; slot++)
+        estimator.add_region(slot, num_pages * page_size);
+
+    // Only one region fits in the budget, so they're visited in turn.
+    for (auto slot = uint32_t{}; slot < 4; slot++) {
+        log.dirty(slot, 0);
+        REQUIRE(estimator.sample() == num_pages);
+        REQUIRE(log.calls == slot + 1);
+    }
+
+    for (auto i = std::size_t{}; i < 4; i++)
+        REQUIRE(estimator.working_set(i, 1) == page_size);
+
+    // A region larger than the budget is still sampled.
+    estimator.add_region(4, 4 * num_pages * page_size);
+
+    for (auto i = 0; i < 4; i++)
+        estimator.sample();
+
+    REQUIRE(estimator.sample() == 4 * num_pages);
+}
+
+TEST_CASE("Background sampling") {
+    auto log = FakeDirtyLog{};
+    auto estimator = vm::WorkingSetEstimator{std::ref(log), 1ms, 1024};
+
+    estimator.add_region(0, vm::MmapRegion::page_size());
+    estimator.start();
+
+    while (estimator.samples() < 3)
+        std::this_thread::sleep_for(1ms);
+
+    estimator.stop();
+
+    const auto samples = estimator.samples();
+    std::this_thread::sleep_for(5ms);
+
+    REQUIRE(estimator.samples() == samples);
+    REQUIRE(estimator.cost().count() > 0);
+}
+
+TEST_CASE("Idle page tracking") {
+    auto log = FakeDirtyLog{};
+    auto estimator = vm::WorkingSetEstimator{std::ref(log), 1h, 1024};
+
+    if (!estimator.set_idle_tracking(true))
+        return;
+
+    const auto page_size = vm::MmapRegion::page_size();
+    auto region = vm::MmapRegion{4 * page_size};
+    const auto index = estimator.add_region(0, region.size(), region.addr());
+
+    // Reads aren't seen by dirty logging, but are by idle page tracking.
+    region.data()[0] = 1;
+    estimator.sample();
+
+    const volatile auto value = region.data()[0];
+    REQUIRE(value == 1);
+    estimator.sample();
+
+    REQUIRE(estimator.working_set(index, 1) >= page_size);
+}
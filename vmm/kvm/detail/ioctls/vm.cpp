@@ -2,6 +2,7 @@
 // vm.cpp - VM ioctls
 //
 
+#include <algorithm> // min
 #include <unistd.h> // sysconf, _SC_PAGESIZE
 
 #include "vmm/kvm/detail/ioctls/vm.hpp"
@@ -60,8 +61,46 @@ auto Vm::set_memslot(uint32_t slot, uintptr_t guest_addr,
     set_memslot(mem_region);
 }
 
+auto Vm::set_memslots(uint32_t first_slot, uintptr_t guest_addr,
+                      uint64_t mem_size, uintptr_t user_addr,
+                      uint32_t flags) const -> uint32_t
+{
+    const auto max_size = max_memslot_size();
+
+    auto slot = first_slot;
+    auto offset = uint64_t{};
+
+    while (offset < mem_size) {
+        const auto size = std::min(mem_size - offset, max_size);
+
+        set_memslot(slot++, guest_addr + offset, size, user_addr + offset,
+                    flags);
+        offset += size;
+    }
+
+    return slot - first_slot;
+}
+
+auto Vm::max_memslot_size() -> uint64_t
+{
+    const auto page_size = sysconf(_SC_PAGESIZE);
+
+    if (page_size == -1)
+        VMM_THROW(std::system_error(errno, std::system_category()));
+
+    const auto gib = uint64_t{1} << 30;
+    return MAX_MEMSLOT_PAGES * static_cast<uint64_t>(page_size) / gib * gib;
+}
+
 auto Vm::dirty_log(uint32_t slot,
                    unsigned long mem_size) const -> std::vector<uint64_t> {
+    auto bitmap = std::vector<uint64_t>{};
+    dirty_log(slot, mem_size, bitmap);
+    return bitmap;
+}
+
+auto Vm::dirty_log(uint32_t slot, unsigned long mem_size,
+                   std::vector<uint64_t>& bitmap) const -> void {
     auto page_size = sysconf(_SC_PAGESIZE);
 
     if (page_size == -1)
@@ -70,15 +109,16 @@ auto Vm::dirty_log(uint32_t slot,
     // Ensure all dirty pages are counted even when memory_size isn't a
     // multiple of page_size * 64.
     const auto aligned_size = static_cast<unsigned long>(page_size) * 64;
-    auto bitmap = std::vector<uint64_t>((mem_size + aligned_size - 1) / aligned_size);
+    const auto len = (mem_size + aligned_size - 1) / aligned_size;
+
+    if (bitmap.size() < len)
+        bitmap.resize(len);
 
     auto dirtylog = kvm_dirty_log{};
     dirtylog.slot = slot;
     dirtylog.dirty_bitmap = bitmap.data();
 
     m_fd.ioctl(KVM_GET_DIRTY_LOG, &dirtylog);
-
-    return bitmap;
 }
 
 auto Vm::mmap_size() const -> std::size_t
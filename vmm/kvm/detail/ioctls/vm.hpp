@@ -80,6 +80,20 @@ class Vm
                          uint64_t mem_size, uintptr_t user_addr,
                          uint32_t flags) const -> void;
 
+        // Maps a guest physical memory range of any size, splitting it across
+        // consecutive memory slots starting at `first_slot` wherever it
+        // exceeds `max_memslot_size()`. Returns the number of slots used.
+        //
+        // Passing a `mem_size` of 0 is not supported; delete each slot with
+        // `set_memslot()` instead.
+        auto set_memslots(uint32_t first_slot, uintptr_t guest_addr,
+                          uint64_t mem_size, uintptr_t user_addr,
+                          uint32_t flags) const -> uint32_t;
+
+        // Returns the largest size of a single memory slot, rounded down to a
+        // multiple of 1 GiB so that split slots stay hugepage-aligned.
+        [[nodiscard]] static auto max_memslot_size() -> uint64_t;
+
         // Given a memory slot, returns a vector containing any pages dirtied
         // since the last call to this ioctl.
         //
@@ -87,6 +101,16 @@ class Vm
         auto dirty_log(uint32_t slot,
                        unsigned long mem_size) const -> std::vector<uint64_t>;
 
+        // Given a memory slot, fills `bitmap` with any pages dirtied since
+        // the last call to this ioctl.
+        //
+        // The bitmap is only grown, never shrunk, so reusing it across calls
+        // avoids reallocating for large memory slots.
+        //
+        // See the documentation for KVM_GET_DIRTY_LOG.
+        auto dirty_log(uint32_t slot, unsigned long mem_size,
+                       std::vector<uint64_t>& bitmap) const -> void;
+
         // Attaches an ioeventfd to a legal pio/mmio address within the guest.
         //
         // See the documentation for KVM_IOEVENTFD.
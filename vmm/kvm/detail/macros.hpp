@@ -12,3 +12,7 @@
 
 // Defined in linux/arch/x86/include/asm/kvm_host.h
 #define MAX_CPUID_ENTRIES 80
+
+// Maximum number of pages in a single memory slot (KVM_MEM_MAX_NR_PAGES in
+// include/linux/kvm_host.h)
+#define MAX_MEMSLOT_PAGES ((1UL << 31) - 1)
@@ -0,0 +1,62 @@
+//
+// mmap.cpp - Memory-mapped host regions
+//
+
+#include <cerrno> // errno
+#include <system_error> // system_category, system_error
+#include <utility> // exchange
+#include <unistd.h> // sysconf, _SC_PAGESIZE
+
+#include "vmm/memory/detail/mmap.hpp"
+#include "vmm/types/detail/exceptions.hpp"
+
+namespace vmm::memory::detail {
+
+MmapRegion::MmapRegion(std::size_t size, int prot, int flags)
+    : m_size{size}, m_prot{prot}, m_flags{flags}
+{
+    auto addr = ::mmap(nullptr, size, prot, flags, -1, 0);
+
+    if (addr == MAP_FAILED)
+        VMM_THROW(std::system_error(errno, std::system_category()));
+
+    m_addr = static_cast<uint8_t*>(addr);
+}
+
+MmapRegion::~MmapRegion() noexcept
+{
+    if (m_addr)
+        ::munmap(m_addr, m_size);
+}
+
+MmapRegion::MmapRegion(MmapRegion&& other) noexcept
+    : m_addr{std::exchange(other.m_addr, nullptr)},
+      m_size{std::exchange(other.m_size, 0)},
+      m_prot{other.m_prot}, m_flags{other.m_flags} {}
+
+auto MmapRegion::operator=(MmapRegion&& other) noexcept -> MmapRegion&
+{
+    if (this != &other) {
+        if (m_addr)
+            ::munmap(m_addr, m_size);
+
+        m_addr = std::exchange(other.m_addr, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_prot = other.m_prot;
+        m_flags = other.m_flags;
+    }
+
+    return *this;
+}
+
+auto MmapRegion::page_size() -> std::size_t
+{
+    static const auto size = ::sysconf(_SC_PAGESIZE);
+
+    if (size == -1)
+        VMM_THROW(std::system_error(errno, std::system_category()));
+
+    return static_cast<std::size_t>(size);
+}
+
+}  // vmm::memory::detail
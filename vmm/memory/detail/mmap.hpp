@@ -0,0 +1,76 @@
+//
+// mmap.hpp - Memory-mapped host regions
+//
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // uint8_t, uintptr_t
+#include <sys/mman.h> // PROT_*, MAP_*
+
+namespace vmm::memory::detail {
+
+// An owned, page-aligned host mapping that backs guest memory.
+//
+// The mapping is unmapped when the region is destroyed. Regions are move-only
+// since two owners of the same mapping would unmap it twice.
+class MmapRegion
+{
+    private:
+        uint8_t *m_addr = nullptr;
+        std::size_t m_size = 0;
+        int m_prot = 0;
+        int m_flags = 0;
+    public:
+        // Creates an anonymous mapping of `size` bytes.
+        //
+        // By default no swap space is reserved for the mapping, so only the
+        // pages the guest actually touches count towards its footprint. This
+        // keeps multi-terabyte guests cheap to set up.
+        explicit MmapRegion(std::size_t size,
+                            int prot=PROT_READ | PROT_WRITE,
+                            int flags=MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE);
+
+        ~MmapRegion() noexcept;
+
+        MmapRegion(const MmapRegion& other) = delete;
+        MmapRegion(MmapRegion&& other) noexcept;
+        auto operator=(const MmapRegion& other) -> MmapRegion& = delete;
+        auto operator=(MmapRegion&& other) noexcept -> MmapRegion&;
+
+        // Returns a pointer to the start of the mapping.
+        [[nodiscard]] auto data() const noexcept -> uint8_t*
+        {
+            return m_addr;
+        }
+
+        // Returns the start of the mapping as an integer, which is the form
+        // expected by `kvm::Vm::set_memslot()`.
+        [[nodiscard]] auto addr() const noexcept -> uintptr_t
+        {
+            return reinterpret_cast<uintptr_t>(m_addr);
+        }
+
+        // Returns the size of the mapping in bytes.
+        [[nodiscard]] auto size() const noexcept -> std::size_t
+        {
+            return m_size;
+        }
+
+        // Returns the protection flags the region was mapped with.
+        [[nodiscard]] auto prot() const noexcept -> int
+        {
+            return m_prot;
+        }
+
+        // Returns the mmap flags the region was mapped with.
+        [[nodiscard]] auto flags() const noexcept -> int
+        {
+            return m_flags;
+        }
+
+        // Returns the host page size.
+        [[nodiscard]] static auto page_size() -> std::size_t;
+};
+
+}  // vmm::memory::detail
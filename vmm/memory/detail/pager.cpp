@@ -0,0 +1,370 @@
+//
+// pager.cpp - Userspace guest memory overcommit
+//
+
+#include <algorithm> // all_of, min, nth_element
+#include <cerrno> // errno
+#include <cstring> // memcpy, memset
+#include <stdexcept> // runtime_error
+#include <system_error> // system_category, system_error
+#include <fcntl.h> // open, fallocate, O_*, FALLOC_FL_*
+#include <linux/userfaultfd.h> // uffd*, UFFD*
+#include <poll.h> // poll
+#include <sys/syscall.h> // SYS_userfaultfd
+#include <unistd.h> // pread, pwrite, read, syscall
+#include <zlib.h> // compress2, compressBound, uncompress
+
+#include "vmm/memory/detail/pager.hpp"
+#include "vmm/types/detail/exceptions.hpp"
+
+namespace vmm::memory::detail {
+
+namespace {
+
+auto open_store(const std::filesystem::path& path) -> int
+{
+    const auto fd = std::filesystem::is_directory(path)
+        ? ::open(path.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600)
+        : ::open(path.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0600);
+
+    if (fd < 0)
+        VMM_THROW(std::system_error(errno, std::system_category()));
+
+    return fd;
+}
+
+auto open_userfaultfd() -> int
+{
+    const auto fd = static_cast<int>(::syscall(SYS_userfaultfd,
+                                               O_CLOEXEC | O_NONBLOCK));
+
+    if (fd < 0)
+        VMM_THROW(std::system_error(errno, std::system_category()));
+
+    return fd;
+}
+
+}  // namespace
+
+FilePageStore::FilePageStore(const std::filesystem::path& path)
+    : m_fd{open_store(path)}, m_page_size{MmapRegion::page_size()} {}
+
+auto FilePageStore::store(std::size_t index, const uint8_t *src) -> void
+{
+    auto offset = static_cast<off_t>(index * m_page_size);
+    auto done = std::size_t{};
+
+    while (done < m_page_size) {
+        const auto ret = ::pwrite(m_fd.fd(), src + done, m_page_size - done,
+                                  offset + static_cast<off_t>(done));
+
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+
+            VMM_THROW(std::system_error(errno, std::system_category()));
+        }
+
+        done += static_cast<std::size_t>(ret);
+    }
+}
+
+auto FilePageStore::load(std::size_t index, uint8_t *dst) -> void
+{
+    auto offset = static_cast<off_t>(index * m_page_size);
+    auto done = std::size_t{};
+
+    while (done < m_page_size) {
+        const auto ret = ::pread(m_fd.fd(), dst + done, m_page_size - done,
+                                 offset + static_cast<off_t>(done));
+
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+
+            VMM_THROW(std::system_error(errno, std::system_category()));
+        }
+
+        // Holes past the end of the file read back as zeroes.
+        if (ret == 0) {
+            std::memset(dst + done, 0, m_page_size - done);
+            break;
+        }
+
+        done += static_cast<std::size_t>(ret);
+    }
+}
+
+auto FilePageStore::discard(std::size_t index) -> void
+{
+    // Best effort: not every filesystem supports punching holes.
+    ::fallocate(m_fd.fd(), FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                static_cast<off_t>(index * m_page_size),
+                static_cast<off_t>(m_page_size));
+}
+
+PoolPageStore::PoolPageStore(std::size_t num_pages, int level)
+    : m_pages(num_pages), m_page_size{MmapRegion::page_size()}, m_level{level}
+{
+    m_buffer.resize(::compressBound(static_cast<uLong>(m_page_size)));
+}
+
+auto PoolPageStore::store(std::size_t index, const uint8_t *src) -> void
+{
+    discard(index);
+
+    if (std::all_of(src, src + m_page_size, [](auto b) { return b == 0; }))
+        return;
+
+    auto len = static_cast<uLongf>(m_buffer.size());
+    const auto ret = ::compress2(m_buffer.data(), &len, src,
+                                 static_cast<uLong>(m_page_size), m_level);
+
+    // Pages stored at full size are uncompressed.
+    if (ret == Z_OK && len < m_page_size)
+        m_pages[index] = std::vector<uint8_t>(m_buffer.begin(),
+                                              m_buffer.begin() + static_cast<long>(len));
+    else
+        m_pages[index] = std::vector<uint8_t>(src, src + m_page_size);
+
+    m_bytes += m_pages[index].size();
+}
+
+auto PoolPageStore::load(std::size_t index, uint8_t *dst) -> void
+{
+    const auto& page = m_pages[index];
+
+    if (page.empty()) {
+        std::memset(dst, 0, m_page_size);
+        return;
+    }
+
+    if (page.size() == m_page_size) {
+        std::memcpy(dst, page.data(), m_page_size);
+        return;
+    }
+
+    auto len = static_cast<uLongf>(m_page_size);
+    const auto ret = ::uncompress(dst, &len, page.data(),
+                                  static_cast<uLong>(page.size()));
+
+    if (ret != Z_OK || len != m_page_size)
+        VMM_THROW(std::runtime_error("Corrupt page in pool"));
+}
+
+auto PoolPageStore::discard(std::size_t index) -> void
+{
+    m_bytes -= m_pages[index].size();
+    m_pages[index] = std::vector<uint8_t>{};
+}
+
+Pager::Pager(MmapRegion& region, std::unique_ptr<PageStore> store,
+             std::size_t limit, std::size_t readahead)
+    : m_region{region}, m_store{std::move(store)},
+      m_uffd{open_userfaultfd()}, m_page_size{MmapRegion::page_size()},
+      m_limit{limit}, m_readahead{readahead}
+{
+    auto api = uffdio_api{};
+    api.api = UFFD_API;
+    api.features = UFFD_FEATURE_PAGEFAULT_FLAG_WP;
+    m_uffd.ioctl(UFFDIO_API, &api);
+
+    auto reg = uffdio_register{};
+    reg.range.start = region.addr();
+    reg.range.len = region.size();
+    reg.mode = UFFDIO_REGISTER_MODE_MISSING | UFFDIO_REGISTER_MODE_WP;
+    m_uffd.ioctl(UFFDIO_REGISTER, &reg);
+
+    const auto num_pages = region.size() / m_page_size;
+    m_state.resize(num_pages, PageState::Missing);
+    m_age.resize(num_pages);
+    m_buffer.resize(m_page_size * (readahead + 1));
+}
+
+Pager::~Pager() noexcept
+{
+    auto range = uffdio_range{m_region.addr(), m_region.size()};
+    ::ioctl(m_uffd.fd(), UFFDIO_UNREGISTER, &range);
+}
+
+auto Pager::write_protect(std::size_t index, bool enable) -> void
+{
+    auto wp = uffdio_writeprotect{};
+    wp.range.start = m_region.addr() + index * m_page_size;
+    wp.range.len = m_page_size;
+    wp.mode = enable ? UFFDIO_WRITEPROTECT_MODE_WP : 0;
+    m_uffd.ioctl(UFFDIO_WRITEPROTECT, &wp);
+}
+
+auto Pager::evict_page(std::size_t index) -> void
+{
+    auto page = m_region.data() + index * m_page_size;
+
+    // Writes from here on fault to this thread, which only serves them after
+    // the page is gone. The writer then retries and faults the page back in.
+    write_protect(index, true);
+    m_store->store(index, page);
+
+    if (::madvise(page, m_page_size, MADV_DONTNEED) < 0)
+        VMM_THROW(std::system_error(errno, std::system_category()));
+
+    m_state[index] = PageState::Evicted;
+    m_resident--;
+    m_evictions++;
+}
+
+auto Pager::fault_in(std::size_t index) -> void
+{
+    const auto start = m_region.addr() + index * m_page_size;
+
+    if (m_state[index] == PageState::Missing) {
+        auto zero = uffdio_zeropage{};
+        zero.range.start = start;
+        zero.range.len = m_page_size;
+
+        if (::ioctl(m_uffd.fd(), UFFDIO_ZEROPAGE, &zero) < 0 && errno != EEXIST)
+            VMM_THROW(std::system_error(errno, std::system_category()));
+
+        m_state[index] = PageState::Resident;
+        m_age[index] = 0;
+        m_resident++;
+        return;
+    }
+
+    // Read the faulting page and any evicted pages right after it.
+    auto count = std::size_t{1};
+    while (count <= m_readahead && index + count < m_state.size() &&
+            m_state[index + count] == PageState::Evicted)
+        count++;
+
+    for (auto i = std::size_t{}; i < count; i++)
+        m_store->load(index + i, m_buffer.data() + i * m_page_size);
+
+    auto done = std::size_t{};
+    while (done < count) {
+        auto copy = uffdio_copy{};
+        copy.dst = start + done * m_page_size;
+        copy.src = reinterpret_cast<uintptr_t>(m_buffer.data() + done * m_page_size);
+        copy.len = (count - done) * m_page_size;
+
+        if (::ioctl(m_uffd.fd(), UFFDIO_COPY, &copy) == 0) {
+            done = count;
+        }
+        else if (copy.copy > 0) {
+            done += static_cast<std::size_t>(copy.copy) / m_page_size;
+        }
+        else if (errno == EEXIST) {
+            done++;
+        }
+        else if (errno != EAGAIN) {
+            VMM_THROW(std::system_error(errno, std::system_category()));
+        }
+    }
+
+    for (auto i = index; i < index + count; i++) {
+        m_store->discard(i);
+        m_state[i] = PageState::Resident;
+        m_age[i] = 0;
+    }
+
+    m_resident += count;
+    m_readahead_pages += count - 1;
+}
+
+auto Pager::mark_accessed(const std::vector<uint64_t>& bitmap) -> void
+{
+    for (auto i = std::size_t{}; i < m_state.size(); i++) {
+        if (m_state[i] != PageState::Resident)
+            continue;
+
+        const auto word = i / 64;
+        const auto accessed = word < bitmap.size() &&
+                              (bitmap[word] >> (i % 64)) & 1;
+
+        if (accessed)
+            m_age[i] = 0;
+        else if (m_age[i] < UINT8_MAX)
+            m_age[i]++;
+    }
+}
+
+auto Pager::evict(std::size_t n) -> std::size_t
+{
+    auto victims = std::vector<std::size_t>{};
+    victims.reserve(m_resident);
+
+    for (auto i = std::size_t{}; i < m_state.size(); i++) {
+        if (m_state[i] == PageState::Resident)
+            victims.push_back(i);
+    }
+
+    n = std::min(n, victims.size());
+
+    std::nth_element(victims.begin(), victims.begin() + static_cast<long>(n),
+                     victims.end(), [this](auto a, auto b) {
+                         return m_age[a] > m_age[b];
+                     });
+
+    for (auto i = std::size_t{}; i < n; i++)
+        evict_page(victims[i]);
+
+    return n;
+}
+
+auto Pager::balance() -> std::size_t
+{
+    return m_resident > m_limit ? evict(m_resident - m_limit) : 0;
+}
+
+auto Pager::handle_faults(int timeout_ms) -> std::size_t
+{
+    auto pfd = pollfd{m_uffd.fd(), POLLIN, 0};
+
+    if (::poll(&pfd, 1, timeout_ms) <= 0)
+        return 0;
+
+    auto served = std::size_t{};
+    auto msg = uffd_msg{};
+
+    while (::read(m_uffd.fd(), &msg, sizeof(msg)) == sizeof(msg)) {
+        if (msg.event != UFFD_EVENT_PAGEFAULT)
+            continue;
+
+        const auto addr = msg.arg.pagefault.address;
+        const auto index = (addr - m_region.addr()) / m_page_size;
+
+        if (msg.arg.pagefault.flags & UFFD_PAGEFAULT_FLAG_WP) {
+            // A write raced with an eviction. If the page is still around,
+            // let the write through. Otherwise, wake the writer so that it
+            // takes a missing fault instead.
+            if (m_state[index] == PageState::Resident) {
+                write_protect(index, false);
+            }
+            else {
+                auto range = uffdio_range{m_region.addr() + index * m_page_size,
+                                          m_page_size};
+                m_uffd.ioctl(UFFDIO_WAKE, &range);
+            }
+        }
+        else if (m_state[index] == PageState::Resident) {
+            auto range = uffdio_range{m_region.addr() + index * m_page_size,
+                                      m_page_size};
+            m_uffd.ioctl(UFFDIO_WAKE, &range);
+        }
+        else {
+            fault_in(index);
+            m_faults++;
+        }
+
+        served++;
+    }
+
+    if (errno != EAGAIN)
+        VMM_THROW(std::system_error(errno, std::system_category()));
+
+    balance();
+
+    return served;
+}
+
+}  // vmm::memory::detail
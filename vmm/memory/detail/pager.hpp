@@ -0,0 +1,201 @@
+//
+// pager.hpp - Userspace guest memory overcommit
+//
+
+#pragma once
+
+#include <cstddef> // size_t
+#include <cstdint> // uint*_t
+#include <filesystem> // path
+#include <memory> // unique_ptr
+#include <vector> // vector
+
+#include "vmm/memory/detail/mmap.hpp"
+#include "vmm/types/file_descriptor.hpp"
+
+namespace vmm::memory::detail {
+
+// Storage for guest pages that have been evicted from a region.
+//
+// Pages are identified by their index within the region. Implementations are
+// only ever accessed from the pager's thread.
+class PageStore
+{
+    public:
+        virtual ~PageStore() = default;
+
+        // Saves the contents of page `index`.
+        virtual auto store(std::size_t index, const uint8_t *src) -> void = 0;
+
+        // Reads the contents of page `index` into `dst`.
+        virtual auto load(std::size_t index, uint8_t *dst) -> void = 0;
+
+        // Releases any space used by page `index`.
+        virtual auto discard(std::size_t index) -> void = 0;
+};
+
+// Stores evicted pages in a local file, one page-sized slot per page.
+//
+// If `path` is a directory, an unnamed temporary file is created inside of
+// it and is removed once the store is destroyed.
+class FilePageStore : public PageStore
+{
+    private:
+        vmm::types::FileDescriptor m_fd;
+        std::size_t m_page_size;
+    public:
+        explicit FilePageStore(const std::filesystem::path& path);
+
+        auto store(std::size_t index, const uint8_t *src) -> void override;
+        auto load(std::size_t index, uint8_t *dst) -> void override;
+        auto discard(std::size_t index) -> void override;
+};
+
+// Stores evicted pages in host memory, compressed with zlib.
+//
+// Zero pages take up no space at all and pages which don't compress are kept
+// as-is.
+class PoolPageStore : public PageStore
+{
+    private:
+        std::vector<std::vector<uint8_t>> m_pages;
+        std::vector<uint8_t> m_buffer;
+        std::size_t m_page_size;
+        std::size_t m_bytes = 0;
+        int m_level;
+    public:
+        explicit PoolPageStore(std::size_t num_pages, int level=1);
+
+        auto store(std::size_t index, const uint8_t *src) -> void override;
+        auto load(std::size_t index, uint8_t *dst) -> void override;
+        auto discard(std::size_t index) -> void override;
+
+        // Returns the number of bytes currently held by the pool.
+        [[nodiscard]] auto bytes() const noexcept -> std::size_t
+        {
+            return m_bytes;
+        }
+};
+
+// Evicts cold pages of a region to a `PageStore` and faults them back in
+// through userfaultfd.
+//
+// The region is registered for missing and write-protect faults. Pages are
+// aged by `mark_accessed()`, typically with the bitmap returned by
+// `kvm::Vm::dirty_log()` for the memslot backed by the region, and the oldest
+// resident pages are chosen as victims. Before a victim is written out it is
+// write-protected so that concurrent guest writes can't be lost, and once
+// stored it is dropped with MADV_DONTNEED. When the guest touches it again,
+// the page and up to `readahead` evicted neighbours are copied back in.
+//
+// A pager is not thread-safe: `evict()`, `balance()` and `handle_faults()`
+// must all be called from the same thread. vCPU threads faulting on the
+// region block until that thread serves them.
+//
+// Pages still evicted when the pager is destroyed are lost and read back as
+// zeroes.
+class Pager
+{
+    private:
+        enum class PageState : uint8_t {
+            Missing,  // Never populated
+            Resident, // Present in the region
+            Evicted,  // Saved in the page store
+        };
+
+        MmapRegion& m_region;
+        std::unique_ptr<PageStore> m_store;
+        vmm::types::FileDescriptor m_uffd;
+        std::size_t m_page_size;
+        std::size_t m_limit;
+        std::size_t m_readahead;
+
+        std::vector<PageState> m_state;
+        std::vector<uint8_t> m_age;
+        std::vector<uint8_t> m_buffer;
+
+        std::size_t m_resident = 0;
+        std::size_t m_evictions = 0;
+        std::size_t m_faults = 0;
+        std::size_t m_readahead_pages = 0;
+
+        auto write_protect(std::size_t index, bool enable) -> void;
+        auto fault_in(std::size_t index) -> void;
+        auto evict_page(std::size_t index) -> void;
+    public:
+        // Registers `region` with a new userfaultfd.
+        //
+        // At most `limit` pages of the region are kept resident by
+        // `balance()`.
+        Pager(MmapRegion& region, std::unique_ptr<PageStore> store,
+              std::size_t limit, std::size_t readahead=8);
+
+        ~Pager() noexcept;
+
+        Pager(const Pager& other) = delete;
+        Pager(Pager&& other) = delete;
+        auto operator=(const Pager& other) -> Pager& = delete;
+        auto operator=(Pager&& other) -> Pager& = delete;
+
+        // Returns the userfaultfd, which becomes readable whenever a fault is
+        // pending.
+        [[nodiscard]] auto fd() const noexcept -> int
+        {
+            return m_uffd.fd();
+        }
+
+        // Ages every resident page and resets the age of any page whose bit
+        // is set in `bitmap` (one bit per page, as in KVM_GET_DIRTY_LOG).
+        auto mark_accessed(const std::vector<uint64_t>& bitmap) -> void;
+
+        // Evicts up to `n` of the oldest resident pages. Returns the number
+        // of pages evicted.
+        auto evict(std::size_t n) -> std::size_t;
+
+        // Evicts pages until no more than the pager's limit are resident.
+        // Returns the number of pages evicted.
+        auto balance() -> std::size_t;
+
+        // Serves pending page faults, waiting up to `timeout_ms` milliseconds
+        // for the first one (-1 waits indefinitely). Returns the number of
+        // faults served.
+        auto handle_faults(int timeout_ms=0) -> std::size_t;
+
+        // Returns the maximum number of resident pages.
+        [[nodiscard]] auto limit() const noexcept -> std::size_t
+        {
+            return m_limit;
+        }
+
+        // Sets the maximum number of resident pages.
+        auto set_limit(std::size_t limit) noexcept -> void
+        {
+            m_limit = limit;
+        }
+
+        // Returns the number of pages currently resident in the region.
+        [[nodiscard]] auto resident() const noexcept -> std::size_t
+        {
+            return m_resident;
+        }
+
+        // Returns the total number of pages evicted.
+        [[nodiscard]] auto evictions() const noexcept -> std::size_t
+        {
+            return m_evictions;
+        }
+
+        // Returns the total number of page faults served.
+        [[nodiscard]] auto faults() const noexcept -> std::size_t
+        {
+            return m_faults;
+        }
+
+        // Returns the total number of pages brought in by readahead.
+        [[nodiscard]] auto readahead_pages() const noexcept -> std::size_t
+        {
+            return m_readahead_pages;
+        }
+};
+
+}  // vmm::memory::detail
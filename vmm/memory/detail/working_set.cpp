@@ -0,0 +1,272 @@
+//
+// working_set.cpp - Guest working set estimation
+//
+
+#include <algorithm> // clamp, max, min, upper_bound
+#include <cerrno> // errno
+#include <system_error> // system_category, system_error
+#include <fcntl.h> // open, O_*
+#include <unistd.h> // pread, pwrite
+
+#include "vmm/memory/detail/mmap.hpp"
+#include "vmm/memory/detail/working_set.hpp"
+#include "vmm/types/detail/exceptions.hpp"
+
+namespace vmm::memory::detail {
+
+namespace {
+
+// Bits of a /proc/<pid>/pagemap entry.
+constexpr auto PAGEMAP_PRESENT = uint64_t{1} << 63;
+constexpr auto PAGEMAP_PFN_MASK = (uint64_t{1} << 55) - 1;
+
+auto open_file(const char *path, int flags) -> int
+{
+    const auto fd = ::open(path, flags | O_CLOEXEC);
+
+    if (fd < 0)
+        VMM_THROW(std::system_error(errno, std::system_category()));
+
+    return fd;
+}
+
+template<typename T>
+auto pread_value(int fd, off_t offset) -> T
+{
+    auto value = T{};
+
+    if (::pread(fd, &value, sizeof(T), offset) != sizeof(T))
+        VMM_THROW(std::system_error(errno, std::system_category()));
+
+    return value;
+}
+
+}  // namespace
+
+IdlePageTracker::IdlePageTracker()
+    : m_pagemap{open_file("/proc/self/pagemap", O_RDONLY)},
+      m_bitmap{open_file("/sys/kernel/mm/page_idle/bitmap", O_RDWR)},
+      m_page_size{MmapRegion::page_size()} {}
+
+auto IdlePageTracker::accessed(uintptr_t addr, std::size_t num_pages,
+                               std::vector<uint64_t>& bitmap) -> void
+{
+    bitmap.resize(std::max(bitmap.size(), (num_pages + 63) / 64));
+
+    for (auto i = std::size_t{}; i < num_pages; i++) {
+        const auto vpn = (addr + i * m_page_size) / m_page_size;
+        const auto entry = pread_value<uint64_t>(m_pagemap.fd(),
+                                                 static_cast<off_t>(vpn * 8));
+
+        if (!(entry & PAGEMAP_PRESENT))
+            continue;
+
+        // The idle bitmap must be accessed in 8-byte words.
+        const auto pfn = entry & PAGEMAP_PFN_MASK;
+        const auto offset = static_cast<off_t>(pfn / 64 * 8);
+        const auto bit = uint64_t{1} << (pfn % 64);
+        const auto idle = pread_value<uint64_t>(m_bitmap.fd(), offset);
+
+        if (!(idle & bit))
+            bitmap[i / 64] |= uint64_t{1} << (i % 64);
+
+        // Writing a 1 marks the page idle; zeroes are ignored.
+        if (::pwrite(m_bitmap.fd(), &bit, sizeof(bit), offset) != sizeof(bit))
+            VMM_THROW(std::system_error(errno, std::system_category()));
+    }
+}
+
+WorkingSetEstimator::WorkingSetEstimator(DirtyLog dirty_log,
+                                         std::chrono::milliseconds interval,
+                                         std::size_t budget,
+                                         std::vector<uint8_t> buckets)
+    : m_dirty_log{std::move(dirty_log)}, m_interval{interval},
+      m_budget{budget}, m_buckets{std::move(buckets)},
+      m_page_size{MmapRegion::page_size()} {}
+
+WorkingSetEstimator::~WorkingSetEstimator()
+{
+    stop();
+}
+
+auto WorkingSetEstimator::add_region(uint32_t slot, uint64_t size,
+                                     uintptr_t host_addr) -> std::size_t
+{
+    const auto lock = std::lock_guard{m_mutex};
+    const auto num_pages = (size + m_page_size - 1) / m_page_size;
+
+    m_regions.push_back(Region{
+        slot,
+        size,
+        host_addr,
+        std::vector<uint8_t>(num_pages, UINT8_MAX),
+        std::chrono::steady_clock::now(),
+    });
+
+    return m_regions.size() - 1;
+}
+
+auto WorkingSetEstimator::set_idle_tracking(bool enable) -> bool
+{
+    const auto lock = std::lock_guard{m_mutex};
+
+    if (!enable) {
+        m_idle.reset();
+        return false;
+    }
+
+    if (!m_idle) {
+        VMM_TRY {
+            m_idle.emplace();
+        }
+        VMM_CATCH(const std::system_error&) {
+            m_idle.reset();
+        }
+    }
+
+    return m_idle.has_value();
+}
+
+auto WorkingSetEstimator::sample_region(Region& region) -> void
+{
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed = (now - region.last_sample) / m_interval;
+    const auto step = static_cast<unsigned>(std::clamp<decltype(elapsed)>(elapsed, 1,
+                                                                          UINT8_MAX));
+    const auto num_pages = region.ages.size();
+
+    auto bitmap = m_dirty_log(region.slot, region.size);
+
+    if (m_idle && region.host_addr)
+        m_idle->accessed(region.host_addr, num_pages, bitmap);
+
+    for (auto i = std::size_t{}; i < num_pages; i++) {
+        const auto word = i / 64;
+        const auto accessed = word < bitmap.size() &&
+                              (bitmap[word] >> (i % 64)) & 1;
+
+        if (accessed)
+            region.ages[i] = 0;
+        else
+            region.ages[i] = static_cast<uint8_t>(std::min(region.ages[i] + step,
+                                                           unsigned{UINT8_MAX}));
+    }
+
+    region.last_sample = now;
+}
+
+auto WorkingSetEstimator::sample() -> std::size_t
+{
+    const auto lock = std::lock_guard{m_mutex};
+    const auto start = std::chrono::steady_clock::now();
+
+    auto pages = std::size_t{};
+
+    // Always make progress, even if a single region exceeds the budget.
+    for (auto n = std::size_t{}; n < m_regions.size(); n++) {
+        auto& region = m_regions[m_next];
+
+        if (n > 0 && pages + region.ages.size() > m_budget)
+            break;
+
+        sample_region(region);
+        pages += region.ages.size();
+        m_next = (m_next + 1) % m_regions.size();
+    }
+
+    m_samples++;
+    m_cost += std::chrono::steady_clock::now() - start;
+
+    return pages;
+}
+
+auto WorkingSetEstimator::start() -> void
+{
+    const auto lock = std::lock_guard{m_mutex};
+
+    if (m_running)
+        return;
+
+    m_running = true;
+    m_thread = std::thread{[this] {
+        auto guard = std::unique_lock{m_mutex};
+
+        while (!m_cv.wait_for(guard, m_interval, [this] { return !m_running; })) {
+            guard.unlock();
+            sample();
+            guard.lock();
+        }
+    }};
+}
+
+auto WorkingSetEstimator::stop() -> void
+{
+    {
+        const auto lock = std::lock_guard{m_mutex};
+        m_running = false;
+    }
+
+    m_cv.notify_all();
+
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+auto WorkingSetEstimator::histogram(std::size_t region) const -> std::vector<std::size_t>
+{
+    const auto lock = std::lock_guard{m_mutex};
+
+    auto counts = std::vector<std::size_t>(m_buckets.size() + 1);
+
+    for (auto age : m_regions.at(region).ages) {
+        const auto bucket = std::upper_bound(m_buckets.begin(), m_buckets.end(), age);
+        counts[static_cast<std::size_t>(bucket - m_buckets.begin())]++;
+    }
+
+    return counts;
+}
+
+auto WorkingSetEstimator::working_set(std::size_t region,
+                                      uint8_t max_age) const -> uint64_t
+{
+    const auto lock = std::lock_guard{m_mutex};
+
+    auto pages = uint64_t{};
+
+    for (auto age : m_regions.at(region).ages) {
+        if (age < max_age)
+            pages++;
+    }
+
+    return pages * m_page_size;
+}
+
+auto WorkingSetEstimator::working_set(uint8_t max_age) const -> uint64_t
+{
+    auto size = std::size_t{};
+    auto bytes = uint64_t{};
+
+    {
+        const auto lock = std::lock_guard{m_mutex};
+        size = m_regions.size();
+    }
+
+    for (auto i = std::size_t{}; i < size; i++)
+        bytes += working_set(i, max_age);
+
+    return bytes;
+}
+
+auto WorkingSetEstimator::samples() const -> std::size_t
+{
+    const auto lock = std::lock_guard{m_mutex};
+    return m_samples;
+}
+
+auto WorkingSetEstimator::cost() const -> std::chrono::nanoseconds
+{
+    const auto lock = std::lock_guard{m_mutex};
+    return m_cost;
+}
+
+}  // vmm::memory::detail
@@ -0,0 +1,143 @@
+//
+// working_set.hpp - Guest working set estimation
+//
+
+#pragma once
+
+#include <chrono> // milliseconds, nanoseconds, steady_clock
+#include <condition_variable> // condition_variable
+#include <cstddef> // size_t
+#include <cstdint> // uint*_t, uintptr_t
+#include <functional> // function
+#include <mutex> // mutex
+#include <optional> // optional
+#include <thread> // thread
+#include <vector> // vector
+
+#include "vmm/types/file_descriptor.hpp"
+
+namespace vmm::memory::detail {
+
+// Reports which pages of the calling process were accessed using the
+// kernel's idle page tracking.
+//
+// Requires CAP_SYS_ADMIN and CONFIG_IDLE_PAGE_TRACKING. Unlike dirty logging,
+// reads are detected as well as writes.
+class IdlePageTracker
+{
+    private:
+        vmm::types::FileDescriptor m_pagemap;
+        vmm::types::FileDescriptor m_bitmap;
+        std::size_t m_page_size;
+    public:
+        // Opens the calling process' pagemap and the idle page bitmap.
+        IdlePageTracker();
+
+        // Sets bits in `bitmap` for every page in [addr, addr + num_pages)
+        // that was accessed since the last call, and marks all of those
+        // pages idle again. Non-present pages are reported as not accessed.
+        auto accessed(uintptr_t addr, std::size_t num_pages,
+                      std::vector<uint64_t>& bitmap) -> void;
+};
+
+// Estimates the working set of guest memory regions by periodically sampling
+// their dirty bitmaps.
+//
+// Each page carries an age: the number of sample intervals since it was last
+// seen accessed (saturating at 255, which also stands for "never"). Ages are
+// summarized per region as a histogram whose buckets are bounded by
+// `buckets`, e.g. { 1, 4 } yields the buckets [0, 1), [1, 4) and [4, 255].
+//
+// The cost of a sample is bounded by `budget`, the maximum number of pages
+// processed in a single call to `sample()`. Regions are visited round-robin,
+// so when the budget is smaller than the total guest size a region's ages
+// still advance by the number of intervals elapsed since it was last seen.
+class WorkingSetEstimator
+{
+    public:
+        // Returns the bitmap of pages dirtied since the last call for a
+        // memory slot of the given size, e.g. `kvm::Vm::dirty_log()`.
+        using DirtyLog = std::function<std::vector<uint64_t>(uint32_t slot,
+                                                             uint64_t size)>;
+    private:
+        struct Region
+        {
+            uint32_t slot;
+            uint64_t size;
+            uintptr_t host_addr;
+            std::vector<uint8_t> ages;
+            std::chrono::steady_clock::time_point last_sample;
+        };
+
+        DirtyLog m_dirty_log;
+        std::chrono::milliseconds m_interval;
+        std::size_t m_budget;
+        std::vector<uint8_t> m_buckets;
+        std::optional<IdlePageTracker> m_idle;
+        std::size_t m_page_size;
+
+        std::vector<Region> m_regions;
+        std::size_t m_next = 0;
+        std::size_t m_samples = 0;
+        std::chrono::nanoseconds m_cost{};
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::thread m_thread;
+        bool m_running = false;
+
+        auto sample_region(Region&) -> void;
+    public:
+        WorkingSetEstimator(DirtyLog dirty_log,
+                            std::chrono::milliseconds interval,
+                            std::size_t budget,
+                            std::vector<uint8_t> buckets={1, 2, 4, 8, 16, 32, 64});
+
+        ~WorkingSetEstimator();
+
+        WorkingSetEstimator(const WorkingSetEstimator& other) = delete;
+        WorkingSetEstimator(WorkingSetEstimator&& other) = delete;
+        auto operator=(const WorkingSetEstimator& other) -> WorkingSetEstimator& = delete;
+        auto operator=(WorkingSetEstimator&& other) -> WorkingSetEstimator& = delete;
+
+        // Tracks a memory slot of `size` bytes. Returns the region's index.
+        //
+        // The slot must have been created with KVM_MEM_LOG_DIRTY_PAGES. If
+        // `host_addr` is non-zero and idle page tracking is enabled, the host
+        // mapping backing the slot is checked for accessed pages as well.
+        auto add_region(uint32_t slot, uint64_t size,
+                        uintptr_t host_addr=0) -> std::size_t;
+
+        // Enables or disables idle page tracking. Returns whether idle page
+        // tracking is in use.
+        auto set_idle_tracking(bool enable) -> bool;
+
+        // Samples regions until the budget is spent. Returns the number of
+        // pages processed.
+        auto sample() -> std::size_t;
+
+        // Starts sampling every interval on a background thread.
+        auto start() -> void;
+
+        // Stops the background thread, if any.
+        auto stop() -> void;
+
+        // Returns the number of pages of a region in each age bucket.
+        [[nodiscard]] auto histogram(std::size_t region) const -> std::vector<std::size_t>;
+
+        // Returns the number of bytes of a region accessed within the last
+        // `max_age` intervals.
+        [[nodiscard]] auto working_set(std::size_t region, uint8_t max_age) const -> uint64_t;
+
+        // Returns the number of bytes of all regions accessed within the last
+        // `max_age` intervals.
+        [[nodiscard]] auto working_set(uint8_t max_age) const -> uint64_t;
+
+        // Returns the number of calls to `sample()` so far.
+        [[nodiscard]] auto samples() const -> std::size_t;
+
+        // Returns the total time spent sampling.
+        [[nodiscard]] auto cost() const -> std::chrono::nanoseconds;
+};
+
+}  // vmm::memory::detail
@@ -6,6 +6,9 @@
 
 #include "vmm/memory/detail/address.hpp"
 #include "vmm/memory/detail/guest.hpp"
+#include "vmm/memory/detail/mmap.hpp"
+#include "vmm/memory/detail/pager.hpp"
+#include "vmm/memory/detail/working_set.hpp"
 
 namespace vmm::memory {
 
@@ -21,4 +24,14 @@ using GuestAddress = vmm::memory::detail::GuestAddress;
 
 //using FileOffset = vmm::memory::detail::FileOffset;
 
+using MmapRegion = vmm::memory::detail::MmapRegion;
+
+using PageStore = vmm::memory::detail::PageStore;
+using FilePageStore = vmm::memory::detail::FilePageStore;
+using PoolPageStore = vmm::memory::detail::PoolPageStore;
+using Pager = vmm::memory::detail::Pager;
+
+using IdlePageTracker = vmm::memory::detail::IdlePageTracker;
+using WorkingSetEstimator = vmm::memory::detail::WorkingSetEstimator;
+
 }  // vmm::memory